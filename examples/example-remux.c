@@ -0,0 +1,759 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* for copy_file_range */
+#endif
+
+#include "example-shared.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+/* example that moves ALAC packets between a CAF file and an M4A file
+ * without decoding them. The packets and the "magic cookie" from
+ * technicallyalac_cookie() are the same in both containers, so all that
+ * changes is the framing around them.
+ *
+ * the direction is picked from the input file:
+ *     example-remux input.caf output.m4a
+ *     example-remux input.m4a output.caf
+ *
+ * packet payloads are moved with copy_file_range() on Linux, so the data
+ * never has to pass through this program's memory. Elsewhere (or if the
+ * kernel refuses, say across filesystems) it falls back to fread/fwrite. */
+
+#define COOKIE_SIZE 24
+#define COPY_BUFFER_SIZE 65536
+
+struct remux_s {
+    uint8_t  cookie[COOKIE_SIZE];
+    uint32_t framelength;
+    uint32_t samplerate;
+    uint8_t  channels;
+    uint8_t  bitdepth;
+
+    uint64_t packets;
+    uint32_t *sizes;   /* size of each packet, in bytes */
+    uint64_t *offsets; /* where each packet lives in the input file */
+    uint64_t payload;  /* sum of sizes */
+    uint32_t remainder; /* frames to trim off the final packet */
+};
+
+typedef struct remux_s remux;
+
+static int remux_alloc(remux *r, uint64_t packets) {
+    if(packets == 0 || packets > (SIZE_MAX / sizeof(uint64_t))) return -1;
+    r->packets = packets;
+    r->sizes = (uint32_t *)malloc(sizeof(uint32_t) * packets);
+    r->offsets = (uint64_t *)malloc(sizeof(uint64_t) * packets);
+    if(r->sizes == NULL || r->offsets == NULL) abort();
+    return 0;
+}
+
+static int remux_cookie(remux *r, const uint8_t *cookie) {
+    memcpy(r->cookie,cookie,COOKIE_SIZE);
+    r->framelength = unpack_uint32be(&cookie[0]);
+    r->bitdepth = cookie[5];
+    r->channels = cookie[9];
+    r->samplerate = unpack_uint32be(&cookie[20]);
+    if(r->framelength == 0 || r->channels == 0) return -1;
+    return 0;
+}
+
+/* copies len bytes starting at offset in the input to the current
+ * position of the output */
+static int copy_range(FILE *output, FILE *input, uint64_t offset, uint64_t len) {
+    uint8_t buffer[COPY_BUFFER_SIZE];
+    size_t chunk = 0;
+#if defined(__linux__)
+    loff_t in_off = (loff_t)offset;
+    ssize_t r = 0;
+
+    if(fflush(output) != 0) return -1;
+    while(len > 0) {
+        r = copy_file_range(fileno(input),&in_off,fileno(output),NULL,len > 0x40000000 ? 0x40000000 : (size_t)len,0);
+        if(r <= 0) break;
+        len -= (uint64_t)r;
+    }
+    offset = (uint64_t)in_off;
+    /* sync the FILE position with what the kernel wrote */
+    if(fseek(output,0,SEEK_END) != 0) return -1;
+#endif
+
+    if(len > 0 && fseek(input,(long)offset,SEEK_SET) != 0) return -1;
+    while(len > 0) {
+        chunk = len > COPY_BUFFER_SIZE ? COPY_BUFFER_SIZE : (size_t)len;
+        if(fread(buffer,1,chunk,input) != chunk) return -1;
+        if(fwrite(buffer,1,chunk,output) != chunk) return -1;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/* copies all the packets, one range per run of back-to-back packets */
+static int copy_packets(FILE *output, FILE *input, remux *r) {
+    uint64_t i = 0;
+    uint64_t start = 0;
+    uint64_t len = 0;
+
+    while(i < r->packets) {
+        start = r->offsets[i];
+        len = 0;
+        do {
+            len += r->sizes[i++];
+        } while(i < r->packets && r->offsets[i] == start + len);
+        if(copy_range(output,input,start,len) != 0) return -1;
+    }
+    return 0;
+}
+
+/* CAF packet tables store sizes as big-endian base-128 varints */
+static int read_varint(FILE *f, uint64_t *v) {
+    int c = 0;
+    unsigned int i = 0;
+    *v = 0;
+    for(i = 0; i < 10; i++) {
+        if((c = fgetc(f)) == EOF) return -1;
+        *v = (*v << 7) | (uint64_t)(c & 0x7F);
+        if(!(c & 0x80)) return 0;
+    }
+    return -1;
+}
+
+static void write_varint(FILE *f, uint64_t v) {
+    uint8_t buffer[10];
+    unsigned int i = sizeof(buffer) - 1;
+    buffer[i] = (uint8_t)(v & 0x7F); /* last byte has the high bit clear */
+    while(v >>= 7) {
+        buffer[--i] = (uint8_t)((v & 0x7F) | 0x80);
+    }
+    fwrite(&buffer[i],1,sizeof(buffer) - i,f);
+}
+
+static unsigned int varint_size(uint64_t v) {
+    unsigned int i = 0;
+    do {
+        i++;
+        v >>= 7;
+    } while(v);
+    return i;
+}
+
+static int read_caf(FILE *input, remux *r) {
+    uint8_t type[4];
+    uint8_t kuki[256];
+    uint64_t size = 0;
+    uint64_t pos = 0;
+    uint32_t bytes_per_packet = 0;
+    uint32_t frames_per_packet = 0;
+    uint32_t remainder = 0;
+    uint64_t data_offset = 0;
+    uint64_t data_len = 0;
+    uint64_t pakt_offset = 0;
+    uint64_t num_packets = 0;
+    uint64_t tmp = 0;
+    uint64_t i = 0;
+    int have_desc = 0;
+    int have_kuki = 0;
+    int have_data = 0;
+    int have_pakt = 0;
+
+    if(fseek(input,8,SEEK_SET) != 0) return -1;
+
+    while(fread(type,1,4,input) == 4) {
+        if(read_uint64(input,&size) != 8) return -1;
+        pos = (uint64_t)ftell(input);
+
+        if(memcmp(type,"desc",4) == 0) {
+            if(size < 32) return -1;
+            fseek(input,8,SEEK_CUR); /* sample rate, we use the cookie's */
+            if(fread(type,1,4,input) != 4 || memcmp(type,"alac",4) != 0) {
+                fprintf(stderr,"not an ALAC CAF file\n");
+                return -1;
+            }
+            fseek(input,4,SEEK_CUR); /* format flags */
+            read_uint32(input,&bytes_per_packet);
+            read_uint32(input,&frames_per_packet);
+            have_desc = 1;
+        } else if(memcmp(type,"kuki",4) == 0) {
+            if(size < COOKIE_SIZE || size > sizeof(kuki)) return -1;
+            if(fread(kuki,1,(size_t)size,input) != size) return -1;
+            /* some muxers wrap the cookie in frma/alac atoms, skip those */
+            tmp = 0;
+            if(size >= 12 + 12 + COOKIE_SIZE && memcmp(&kuki[4],"frma",4) == 0) {
+                tmp = 12;
+                if(memcmp(&kuki[tmp + 4],"alac",4) == 0) tmp += 12;
+            }
+            if(tmp + COOKIE_SIZE > size || remux_cookie(r,&kuki[tmp]) != 0) return -1;
+            have_kuki = 1;
+        } else if(memcmp(type,"pakt",4) == 0) {
+            if(size < 24) return -1;
+            read_uint64(input,&num_packets);
+            fseek(input,8+4,SEEK_CUR); /* valid frames, priming frames */
+            read_uint32(input,&remainder);
+            pakt_offset = pos + 24;
+            have_pakt = 1;
+        } else if(memcmp(type,"data",4) == 0) {
+            data_offset = pos + 4; /* skip the edit count */
+            if(size == UINT64_MAX) { /* size -1 means "until the end of the file" */
+                fseek(input,0,SEEK_END);
+                size = (uint64_t)ftell(input) - pos;
+            }
+            if(size < 4) return -1;
+            data_len = size - 4;
+            have_data = 1;
+        }
+
+        if(fseek(input,(long)(pos + size),SEEK_SET) != 0) break;
+    }
+
+    if(!have_desc || !have_kuki || !have_data) {
+        fprintf(stderr,"CAF file is missing a desc, kuki or data chunk\n");
+        return -1;
+    }
+    if(frames_per_packet != r->framelength) {
+        fprintf(stderr,"variable frames per packet is not supported\n");
+        return -1;
+    }
+
+    if(bytes_per_packet != 0) {
+        /* constant packet sizes, no table needed */
+        if(remux_alloc(r,data_len / bytes_per_packet) != 0) return -1;
+        for(i = 0; i < r->packets; i++) {
+            r->sizes[i] = bytes_per_packet;
+        }
+    } else {
+        if(!have_pakt || remux_alloc(r,num_packets) != 0) return -1;
+        fseek(input,(long)pakt_offset,SEEK_SET);
+        for(i = 0; i < r->packets; i++) {
+            if(read_varint(input,&tmp) != 0 || tmp > UINT32_MAX) return -1;
+            r->sizes[i] = (uint32_t)tmp;
+        }
+    }
+
+    tmp = data_offset;
+    for(i = 0; i < r->packets; i++) {
+        r->offsets[i] = tmp;
+        tmp += r->sizes[i];
+    }
+    r->payload = tmp - data_offset;
+    if(r->payload > data_len) return -1;
+
+    r->remainder = remainder < r->framelength ? remainder : 0;
+    return 0;
+}
+
+/* finds a child box in buf, returns a pointer to its payload */
+static const uint8_t *find_box(const uint8_t *buf, uint64_t len, const char *type, uint64_t *box_len) {
+    uint64_t pos = 0;
+    uint64_t size = 0;
+    uint64_t hdr = 0;
+
+    while(pos + 8 <= len) {
+        size = unpack_uint32be(&buf[pos]);
+        hdr = 8;
+        if(size == 1) {
+            if(pos + 16 > len) return NULL;
+            size = unpack_uint64be(&buf[pos+8]);
+            hdr = 16;
+        } else if(size == 0) {
+            size = len - pos;
+        }
+        if(size < hdr || size > len - pos) return NULL;
+        if(memcmp(&buf[pos+4],type,4) == 0) {
+            *box_len = size - hdr;
+            return &buf[pos + hdr];
+        }
+        pos += size;
+    }
+    return NULL;
+}
+
+static int read_trak(const uint8_t *trak, uint64_t trak_len, remux *r) {
+    const uint8_t *p = NULL;
+    const uint8_t *stbl = NULL;
+    const uint8_t *stsz = NULL;
+    const uint8_t *stsc = NULL;
+    const uint8_t *stco = NULL;
+    const uint8_t *stts = NULL;
+    uint64_t len = 0;
+    uint64_t stbl_len = 0;
+    uint64_t stsz_len = 0;
+    uint64_t stsc_len = 0;
+    uint64_t stco_len = 0;
+    uint64_t stts_len = 0;
+    uint64_t duration = 0;
+    uint32_t sample_size = 0;
+    uint32_t sample_count = 0;
+    uint32_t chunks = 0;
+    uint32_t stsc_count = 0;
+    uint32_t stsc_idx = 0;
+    uint32_t per_chunk = 0;
+    uint32_t chunk = 0;
+    uint32_t i = 0;
+    uint32_t j = 0;
+    uint64_t offset = 0;
+    uint64_t sample = 0;
+    int co64 = 0;
+
+    if((p = find_box(trak,trak_len,"mdia",&len)) == NULL) return -1;
+    if((p = find_box(p,len,"minf",&len)) == NULL) return -1;
+    if((stbl = find_box(p,len,"stbl",&stbl_len)) == NULL) return -1;
+
+    /* sample description: fullbox header, entry count, then the first
+     * sample entry, which needs to be alac */
+    if((p = find_box(stbl,stbl_len,"stsd",&len)) == NULL || len < 8 + 8 + 28) return -1;
+    if(memcmp(&p[12],"alac",4) != 0) return -1;
+    /* the sample entry's own alac box holds the cookie */
+    p += 8 + 8 + 28;
+    len -= 8 + 8 + 28;
+    if((p = find_box(p,len,"alac",&len)) == NULL || len < 4 + COOKIE_SIZE) return -1;
+    if(remux_cookie(r,&p[4]) != 0) return -1;
+
+    if((stsz = find_box(stbl,stbl_len,"stsz",&stsz_len)) == NULL || stsz_len < 12) return -1;
+    if((stsc = find_box(stbl,stbl_len,"stsc",&stsc_len)) == NULL || stsc_len < 8) return -1;
+    if((stts = find_box(stbl,stbl_len,"stts",&stts_len)) == NULL || stts_len < 8) return -1;
+    if((stco = find_box(stbl,stbl_len,"stco",&stco_len)) == NULL) {
+        if((stco = find_box(stbl,stbl_len,"co64",&stco_len)) == NULL) return -1;
+        co64 = 1;
+    }
+    if(stco_len < 8) return -1;
+
+    sample_size = unpack_uint32be(&stsz[4]);
+    sample_count = unpack_uint32be(&stsz[8]);
+    if(sample_size == 0 && stsz_len < 12 + (uint64_t)sample_count * 4) return -1;
+    if(remux_alloc(r,sample_count) != 0) return -1;
+    for(i = 0; i < sample_count; i++) {
+        r->sizes[i] = sample_size ? sample_size : unpack_uint32be(&stsz[12 + (i*4)]);
+    }
+
+    chunks = unpack_uint32be(&stco[4]);
+    if(stco_len < 8 + (uint64_t)chunks * (co64 ? 8 : 4)) return -1;
+    stsc_count = unpack_uint32be(&stsc[4]);
+    if(stsc_count == 0 || stsc_len < 8 + (uint64_t)stsc_count * 12) return -1;
+
+    /* walk the chunks to find where each sample is */
+    for(chunk = 1; chunk <= chunks && sample < sample_count; chunk++) {
+        while(stsc_idx + 1 < stsc_count && unpack_uint32be(&stsc[8 + ((stsc_idx+1)*12)]) <= chunk) {
+            stsc_idx++;
+        }
+        per_chunk = unpack_uint32be(&stsc[8 + (stsc_idx*12) + 4]);
+        offset = co64 ? unpack_uint64be(&stco[8 + ((chunk-1)*8)]) : unpack_uint32be(&stco[8 + ((chunk-1)*4)]);
+        for(j = 0; j < per_chunk && sample < sample_count; j++) {
+            r->offsets[sample] = offset;
+            offset += r->sizes[sample];
+            sample++;
+        }
+    }
+    if(sample != sample_count) return -1;
+
+    i = unpack_uint32be(&stts[4]);
+    if(stts_len < 8 + (uint64_t)i * 8) return -1;
+    for(j = 0; j < i; j++) {
+        duration += (uint64_t)unpack_uint32be(&stts[8 + (j*8)]) * (uint64_t)unpack_uint32be(&stts[8 + (j*8) + 4]);
+    }
+
+    r->remainder = 0;
+    if(duration < r->packets * r->framelength && r->packets * r->framelength - duration < r->framelength) {
+        r->remainder = (uint32_t)(r->packets * r->framelength - duration);
+    }
+
+    r->payload = 0;
+    for(sample = 0; sample < r->packets; sample++) {
+        r->payload += r->sizes[sample];
+    }
+    return 0;
+}
+
+static int read_mp4(FILE *input, remux *r) {
+    uint8_t type[4];
+    uint8_t *moov = NULL;
+    const uint8_t *trak = NULL;
+    uint64_t moov_len = 0;
+    uint64_t trak_len = 0;
+    uint64_t pos = 0;
+    uint64_t size = 0;
+    uint32_t size32 = 0;
+    uint32_t hdr = 0;
+    int ret = -1;
+
+    /* find the moov box, which can be before or after the mdat */
+    while(moov == NULL && read_uint32(input,&size32) == 4 && fread(type,1,4,input) == 4) {
+        size = size32;
+        hdr = 8;
+        if(size == 1) {
+            if(read_uint64(input,&size) != 8) return -1;
+            hdr = 16;
+        }
+        if(size == 0 || size < hdr) break;
+        if(memcmp(type,"moov",4) == 0) {
+            moov_len = size - hdr;
+            moov = (uint8_t *)malloc((size_t)moov_len);
+            if(moov == NULL) abort();
+            if(fread(moov,1,(size_t)moov_len,input) != moov_len) {
+                free(moov);
+                return -1;
+            }
+        }
+        pos += size;
+        if(fseek(input,(long)pos,SEEK_SET) != 0) break;
+    }
+
+    if(moov == NULL) {
+        fprintf(stderr,"MP4 file has no moov box\n");
+        return -1;
+    }
+
+    /* use the first track that holds ALAC */
+    pos = 0;
+    while(pos < moov_len && (trak = find_box(&moov[pos],moov_len - pos,"trak",&trak_len)) != NULL) {
+        if(read_trak(trak,trak_len,r) == 0) {
+            ret = 0;
+            break;
+        }
+        free(r->sizes);
+        free(r->offsets);
+        r->sizes = NULL;
+        r->offsets = NULL;
+        pos = (uint64_t)(trak - moov) + trak_len;
+    }
+
+    if(ret != 0) fprintf(stderr,"MP4 file has no ALAC track\n");
+    free(moov);
+    return ret;
+}
+
+static int write_caf(FILE *output, FILE *input, remux *r) {
+    uint64_t i = 0;
+    uint64_t pakt_size = 24;
+    uint32_t bytes_per_packet = r->sizes[0];
+
+    for(i = 1; i < r->packets; i++) {
+        if(r->sizes[i] != bytes_per_packet) {
+            bytes_per_packet = 0;
+            break;
+        }
+    }
+    if(bytes_per_packet == 0) {
+        for(i = 0; i < r->packets; i++) {
+            pakt_size += varint_size(r->sizes[i]);
+        }
+    }
+
+    fwrite("caff",1,4,output);
+    write_uint16(output,1); /* file version */
+    write_uint16(output,0); /* file flags */
+
+    /* begin audio description chunk */
+    fwrite("desc",1,4,output); /* chunk type */
+    write_uint64(output,32); /* size of chunk */
+    write_double(output,(double)r->samplerate); /* sample rate */
+    fwrite("alac",1,4,output); /* format id */
+    write_uint32(output,0); /* format flags */
+    write_uint32(output,bytes_per_packet); /* bytes per packet, 0 = variable */
+    write_uint32(output,r->framelength); /* frames per packet */
+    write_uint32(output,r->channels); /* channels per frame */
+    write_uint32(output,r->bitdepth); /* bits per channel */
+    /* end audio description chunk */
+
+    /* begin cookie chunk */
+    fwrite("kuki",1,4,output); /* chunk type */
+    write_uint64(output,COOKIE_SIZE); /* chunk size */
+    fwrite(r->cookie,1,COOKIE_SIZE,output);
+    /* end cookie chunk */
+
+    /* begin packet table, only lists sizes if they vary */
+    fwrite("pakt",1,4,output); /* chunk type */
+    write_uint64(output,pakt_size); /* chunk size */
+    write_uint64(output,bytes_per_packet ? 0 : r->packets); /* number of packets in the table */
+    write_uint64(output,(r->packets * r->framelength) - r->remainder); /* number of valid frames */
+    write_uint32(output,0); /* priming frames */
+    write_uint32(output,r->remainder); /* remainder frames */
+    if(bytes_per_packet == 0) {
+        for(i = 0; i < r->packets; i++) {
+            write_varint(output,r->sizes[i]);
+        }
+    }
+    /* end packet table */
+
+    /* begin data chunk */
+    fwrite("data",1,4,output); /* chunk type */
+    write_uint64(output,r->payload + 4); /* chunk size */
+    write_uint32(output,0); /* edit count */
+    if(copy_packets(output,input,r) != 0) return -1;
+    /* end data chunk */
+
+    return 0;
+}
+
+/* MP4 boxes get written with a placeholder size, which is
+ * filled in by box_end once we know how big the box is */
+static long box_start(FILE *f, const char *type) {
+    long pos = ftell(f);
+    write_uint32(f,0);
+    fwrite(type,1,4,f);
+    return pos;
+}
+
+static void box_end(FILE *f, long pos) {
+    long end = ftell(f);
+    fseek(f,pos,SEEK_SET);
+    write_uint32(f,(uint32_t)(end - pos));
+    fseek(f,end,SEEK_SET);
+}
+
+static void write_zeros(FILE *f, unsigned int n) {
+    while(n--) fputc(0,f);
+}
+
+static void write_matrix(FILE *f) {
+    write_uint32(f,0x00010000); write_uint32(f,0); write_uint32(f,0);
+    write_uint32(f,0); write_uint32(f,0x00010000); write_uint32(f,0);
+    write_uint32(f,0); write_uint32(f,0); write_uint32(f,0x40000000);
+}
+
+static int write_mp4(FILE *output, FILE *input, remux *r) {
+    uint64_t i = 0;
+    uint64_t duration = (r->packets * r->framelength) - r->remainder;
+    uint32_t sample_size = r->sizes[0];
+    long moov, trak, mdia, minf, dinf, stbl, box;
+    long chunk_offset_pos = 0;
+    long mdat_pos = 0;
+
+    for(i = 1; i < r->packets; i++) {
+        if(r->sizes[i] != sample_size) {
+            sample_size = 0;
+            break;
+        }
+    }
+    if(r->packets > UINT32_MAX || duration > UINT32_MAX) {
+        fprintf(stderr,"too long for 32-bit MP4 tables\n");
+        return -1;
+    }
+
+    box = box_start(output,"ftyp");
+    fwrite("M4A ",1,4,output); /* major brand */
+    write_uint32(output,0); /* minor version */
+    fwrite("M4A mp42isom",1,12,output); /* compatible brands */
+    box_end(output,box);
+
+    moov = box_start(output,"moov");
+
+    box = box_start(output,"mvhd");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,0); /* creation time */
+    write_uint32(output,0); /* modification time */
+    write_uint32(output,r->samplerate); /* timescale */
+    write_uint32(output,(uint32_t)duration); /* duration */
+    write_uint32(output,0x00010000); /* rate, 1.0 */
+    write_uint16(output,0x0100); /* volume, 1.0 */
+    write_zeros(output,10); /* reserved */
+    write_matrix(output);
+    write_zeros(output,24); /* pre-defined */
+    write_uint32(output,2); /* next track id */
+    box_end(output,box);
+
+    trak = box_start(output,"trak");
+
+    box = box_start(output,"tkhd");
+    write_uint32(output,0x00000007); /* version, flags = enabled, in movie, in preview */
+    write_uint32(output,0); /* creation time */
+    write_uint32(output,0); /* modification time */
+    write_uint32(output,1); /* track id */
+    write_uint32(output,0); /* reserved */
+    write_uint32(output,(uint32_t)duration); /* duration, in the mvhd timescale */
+    write_zeros(output,8); /* reserved */
+    write_uint16(output,0); /* layer */
+    write_uint16(output,0); /* alternate group */
+    write_uint16(output,0x0100); /* volume, 1.0 */
+    write_uint16(output,0); /* reserved */
+    write_matrix(output);
+    write_uint32(output,0); /* width */
+    write_uint32(output,0); /* height */
+    box_end(output,box);
+
+    mdia = box_start(output,"mdia");
+
+    box = box_start(output,"mdhd");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,0); /* creation time */
+    write_uint32(output,0); /* modification time */
+    write_uint32(output,r->samplerate); /* timescale */
+    write_uint32(output,(uint32_t)duration); /* duration */
+    write_uint16(output,0x55C4); /* language, "und" */
+    write_uint16(output,0); /* pre-defined */
+    box_end(output,box);
+
+    box = box_start(output,"hdlr");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,0); /* pre-defined */
+    fwrite("soun",1,4,output); /* handler type */
+    write_zeros(output,12); /* reserved */
+    fwrite("SoundHandler",1,13,output); /* name, with terminator */
+    box_end(output,box);
+
+    minf = box_start(output,"minf");
+
+    box = box_start(output,"smhd");
+    write_uint32(output,0); /* version, flags */
+    write_uint16(output,0); /* balance */
+    write_uint16(output,0); /* reserved */
+    box_end(output,box);
+
+    dinf = box_start(output,"dinf");
+    box = box_start(output,"dref");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,1); /* entry count */
+    write_uint32(output,12); /* size */
+    fwrite("url ",1,4,output);
+    write_uint32(output,1); /* version, flags = data is in this file */
+    box_end(output,box);
+    box_end(output,dinf);
+
+    stbl = box_start(output,"stbl");
+
+    box = box_start(output,"stsd");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,1); /* entry count */
+    write_uint32(output,36 + 12 + COOKIE_SIZE); /* sample entry size */
+    fwrite("alac",1,4,output);
+    write_zeros(output,6); /* reserved */
+    write_uint16(output,1); /* data reference index */
+    write_zeros(output,8); /* version, revision, vendor */
+    write_uint16(output,r->channels); /* channel count */
+    write_uint16(output,r->bitdepth); /* sample size */
+    write_uint16(output,0); /* compression id */
+    write_uint16(output,0); /* packet size */
+    write_uint32(output,r->samplerate > 0xFFFF ? 0 : r->samplerate << 16); /* sample rate, 16.16 */
+    write_uint32(output,12 + COOKIE_SIZE); /* size */
+    fwrite("alac",1,4,output);
+    write_uint32(output,0); /* version, flags */
+    fwrite(r->cookie,1,COOKIE_SIZE,output);
+    box_end(output,box);
+
+    box = box_start(output,"stts");
+    write_uint32(output,0); /* version, flags */
+    if(r->remainder && r->packets > 1) {
+        write_uint32(output,2); /* entry count */
+        write_uint32(output,(uint32_t)r->packets - 1);
+        write_uint32(output,r->framelength);
+        write_uint32(output,1);
+        write_uint32(output,r->framelength - r->remainder);
+    } else {
+        write_uint32(output,1); /* entry count */
+        write_uint32(output,(uint32_t)r->packets);
+        write_uint32(output,r->framelength - (r->packets == 1 ? r->remainder : 0));
+    }
+    box_end(output,box);
+
+    /* every packet goes in a single chunk */
+    box = box_start(output,"stsc");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,1); /* entry count */
+    write_uint32(output,1); /* first chunk */
+    write_uint32(output,(uint32_t)r->packets); /* samples per chunk */
+    write_uint32(output,1); /* sample description index */
+    box_end(output,box);
+
+    box = box_start(output,"stsz");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,sample_size); /* 0 = sizes follow */
+    write_uint32(output,(uint32_t)r->packets);
+    if(sample_size == 0) {
+        for(i = 0; i < r->packets; i++) {
+            write_uint32(output,r->sizes[i]);
+        }
+    }
+    box_end(output,box);
+
+    box = box_start(output,"stco");
+    write_uint32(output,0); /* version, flags */
+    write_uint32(output,1); /* entry count */
+    chunk_offset_pos = ftell(output);
+    write_uint32(output,0); /* filled in once we know where mdat starts */
+    box_end(output,box);
+
+    box_end(output,stbl);
+    box_end(output,minf);
+    box_end(output,mdia);
+    box_end(output,trak);
+    box_end(output,moov);
+
+    /* begin mdat, with a 64-bit size if needed */
+    if(r->payload + 8 > UINT32_MAX) {
+        write_uint32(output,1);
+        fwrite("mdat",1,4,output);
+        write_uint64(output,r->payload + 16);
+    } else {
+        write_uint32(output,(uint32_t)(r->payload + 8));
+        fwrite("mdat",1,4,output);
+    }
+    mdat_pos = ftell(output);
+    if((uint64_t)mdat_pos > UINT32_MAX) return -1;
+
+    fseek(output,chunk_offset_pos,SEEK_SET);
+    write_uint32(output,(uint32_t)mdat_pos);
+    fseek(output,mdat_pos,SEEK_SET);
+
+    if(copy_packets(output,input,r) != 0) return -1;
+    /* end mdat */
+
+    return 0;
+}
+
+int main(int argc, const char *argv[]) {
+    uint8_t magic[8];
+    FILE *input;
+    FILE *output;
+    remux r;
+    int is_caf = 0;
+    int ret = 1;
+
+    memset(&r,0,sizeof(remux));
+
+    if(argc < 3) {
+        printf("Usage: %s /path/to/input.(caf|m4a) /path/to/output.(m4a|caf)\n",argv[0]);
+        return 1;
+    }
+
+    input = fopen(argv[1],"rb");
+    if(input == NULL) return 1;
+
+    if(fread(magic,1,8,input) != 8) {
+        fclose(input);
+        return 1;
+    }
+    fseek(input,0,SEEK_SET);
+
+    if(memcmp(magic,"caff",4) == 0) {
+        is_caf = 1;
+        ret = read_caf(input,&r);
+    } else if(memcmp(&magic[4],"ftyp",4) == 0) {
+        ret = read_mp4(input,&r);
+    } else {
+        fprintf(stderr,"input is neither CAF nor MP4\n");
+        ret = -1;
+    }
+
+    if(ret != 0) {
+        fclose(input);
+        quit(1,r.sizes,r.offsets,NULL);
+    }
+
+    output = fopen(argv[2],"wb");
+    if(output == NULL) {
+        fclose(input);
+        quit(1,r.sizes,r.offsets,NULL);
+    }
+
+    ret = is_caf ? write_mp4(output,input,&r) : write_caf(output,input,&r);
+
+    fclose(input);
+    fclose(output);
+    quit(ret == 0 ? 0 : 1,r.sizes,r.offsets,NULL);
+
+    return 0;
+}
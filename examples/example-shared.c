@@ -43,6 +43,23 @@ pack_uint32le(uint8_t *d, uint32_t n) {
     d[3] = (uint8_t)(n >> 24 );
 }
 
+uint16_t unpack_uint16be(const uint8_t *d) {
+    return (((uint16_t)d[0]) << 8 ) |
+           (((uint16_t)d[1])      );
+}
+
+uint32_t unpack_uint32be(const uint8_t *d) {
+    return (((uint32_t)d[0]) << 24) |
+           (((uint32_t)d[1]) << 16) |
+           (((uint32_t)d[2]) << 8 ) |
+           (((uint32_t)d[3])      );
+}
+
+uint64_t unpack_uint64be(const uint8_t *d) {
+    return (((uint64_t)unpack_uint32be(&d[0])) << 32) |
+           (((uint64_t)unpack_uint32be(&d[4]))      );
+}
+
 size_t write_uint16(FILE *f, uint16_t u) {
     uint8_t buffer[2];
     buffer[0] = (uint8_t)(u >> 8 );
@@ -82,3 +99,16 @@ size_t write_double(FILE *f, double v) {
     return write_uint64(f,tmp.d);
 }
 
+size_t read_uint32(FILE *f, uint32_t *u) {
+    uint8_t buffer[4];
+    size_t r = fread(buffer,1,4,f);
+    if(r == 4) *u = unpack_uint32be(buffer);
+    return r;
+}
+
+size_t read_uint64(FILE *f, uint64_t *u) {
+    uint8_t buffer[8];
+    size_t r = fread(buffer,1,8,f);
+    if(r == 8) *u = unpack_uint64be(buffer);
+    return r;
+}
@@ -42,6 +42,10 @@ repack_samples(int32_t *d, int16_t *s, uint32_t channels, uint32_t num, uint8_t
 void
 pack_uint32le(uint8_t *d, uint32_t n);
 
+uint16_t unpack_uint16be(const uint8_t *d);
+uint32_t unpack_uint32be(const uint8_t *d);
+uint64_t unpack_uint64be(const uint8_t *d);
+
 void
 quit(int e, ...);
 
@@ -50,6 +54,9 @@ size_t write_uint64(FILE *f, uint64_t u);
 size_t write_uint32(FILE *f, uint32_t u);
 size_t write_uint16(FILE *f, uint16_t u);
 
+size_t read_uint64(FILE *f, uint64_t *u);
+size_t read_uint32(FILE *f, uint32_t *u);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,10 @@ PERFORMANCE OF THIS SOFTWARE.
 #include <stddef.h>
 #include <assert.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct technicallyalac_s technicallyalac;
 
 #if defined(__GNUC__) && __GNUC__ >= 2 && __GNUC_MINOR__ >= 5
@@ -98,6 +102,7 @@ struct technicallyalac_cookie_state {
 struct technicallyalac_channel_state {
     enum TECHNICALLYALAC_CHANNEL_STATE state;
     uint32_t frame;
+    uint8_t channel;
 };
 
 struct technicallyalac_packet_state {
@@ -211,6 +216,7 @@ int technicallyalac_init(technicallyalac *f, uint32_t framelength, uint32_t samp
     f->pa_state.state   = TECHNICALLYALAC_PACKET_START;
 
     f->ch_state.frame = 0;
+    f->ch_state.channel = 0;
     f->pa_state.channel = 0;
 
     technicallyalac_bitwriter_init(&f->bw);
@@ -320,18 +326,23 @@ int technicallyalac_cookie(technicallyalac *f,uint8_t *output, uint32_t *bytes)
     return r;
 }
 
-static int technicallyalac_channel(technicallyalac *f, uint32_t num_frames, int32_t *frames) {
+/* writes a single element - a single channel element (SCE) for mono,
+ * or a channel pair element (CPE) for stereo. In the uncompressed (escape)
+ * form a CPE shares one header and has the samples interleaved L/R. */
+static int technicallyalac_channel(technicallyalac *f, uint32_t num_frames, int32_t **frames) {
     int r = 1;
     while(f->bw.pos < f->bw.len && r) {
         technicallyalac_bitwriter_flush(&f->bw);
         switch(f->ch_state.state) {
             case TECHNICALLYALAC_CHANNEL_START: {
                 f->ch_state.frame = 0;
+                f->ch_state.channel = 0;
                 f->ch_state.state = TECHNICALLYALAC_CHANNEL_CHANMAP;
                 break;
             }
             case TECHNICALLYALAC_CHANNEL_CHANMAP: {
-                if(technicallyalac_bitwriter_add(&f->bw,3,0)) {
+                /* ID_SCE = 0, ID_CPE = 1 */
+                if(technicallyalac_bitwriter_add(&f->bw,3,f->channels == 2)) {
                     f->ch_state.state = TECHNICALLYALAC_CHANNEL_TAG;
                 }
                 break;
@@ -376,11 +387,15 @@ static int technicallyalac_channel(technicallyalac *f, uint32_t num_frames, int3
                 break;
             }
             case TECHNICALLYALAC_CHANNEL_DATA: {
-                if(technicallyalac_bitwriter_add(&f->bw,f->bitdepth,frames[f->ch_state.frame])) {
-                    f->ch_state.frame++;
-                    if(f->ch_state.frame == num_frames) {
-                        f->ch_state.state = TECHNICALLYALAC_CHANNEL_START;
-                        r = 0;
+                if(technicallyalac_bitwriter_add(&f->bw,f->bitdepth,frames[f->ch_state.channel][f->ch_state.frame])) {
+                    f->ch_state.channel++;
+                    if(f->ch_state.channel == f->channels) {
+                        f->ch_state.channel = 0;
+                        f->ch_state.frame++;
+                        if(f->ch_state.frame == num_frames) {
+                            f->ch_state.state = TECHNICALLYALAC_CHANNEL_START;
+                            r = 0;
+                        }
                     }
                 }
                 break;
@@ -408,11 +423,9 @@ int technicallyalac_packet(technicallyalac *f, uint8_t *output, uint32_t *bytes,
                 break;
             }
             case TECHNICALLYALAC_PACKET_CHANNEL: {
-                if(technicallyalac_channel(f,num_frames,frames[f->pa_state.channel]) == 0) {
-                    f->pa_state.channel++;
-                    if(f->pa_state.channel == f->channels) {
-                        f->pa_state.state = TECHNICALLYALAC_PACKET_END;
-                    }
+                /* mono and stereo are both a single element */
+                if(technicallyalac_channel(f,num_frames,frames) == 0) {
+                    f->pa_state.state = TECHNICALLYALAC_PACKET_END;
                 }
                 break;
             }
@@ -433,22 +446,22 @@ int technicallyalac_packet(technicallyalac *f, uint8_t *output, uint32_t *bytes,
         }
     }
 
+    *bytes = f->bw.pos;
     return r;
 
 }
 
 static uint64_t technicallyalac_packet_size_internal(technicallyalac *f) {
     uint64_t bits = 0;
-    bits +=  3; /* channel tag */
-    bits +=  4; /* channel number */
+    bits +=  3; /* element tag (SCE or CPE) */
+    bits +=  4; /* element instance */
     bits += 12; /* header bits, all zero */
     bits +=  1; /* sample count flag */
     bits +=  2; /* extra bits */
     bits +=  1; /* channel escape */
 
-    bits += (uint64_t)f->bitdepth * (uint64_t)f->framelength; /* raw bits in a frame */
-
-    bits *= (uint64_t)f->channels;
+    /* raw bits in a frame, one header covers both channels of a CPE */
+    bits += (uint64_t)f->bitdepth * (uint64_t)f->framelength * (uint64_t)f->channels;
 
     bits += 3; /* ID_END tag */
     return bits;
@@ -468,8 +481,9 @@ uint32_t technicallyalac_max_packet_size(technicallyalac *f) {
     uint64_t bits = technicallyalac_packet_size_internal(f);
     uint64_t max = bits;
 
-    /* assuming the final block is 1 sample short */
-    max -= f->bitdepth + f->channels;
+    /* assuming the final block is 1 sample short, which
+     * adds a 32-bit sample count to the element header */
+    max -= (uint64_t)f->bitdepth * (uint64_t)f->channels;
     max += 32;
     bits = ( max > bits ? max : bits );
 
@@ -0,0 +1,184 @@
+/*
+Copyright (c) 2022 John Regan
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#ifndef TECHNICALLYALAC_HPP
+#define TECHNICALLYALAC_HPP
+
+/* header-only C++ (C++11 or later) layer over technicallyalac.h */
+
+/* the C functions are resumable - they return 1 when the output buffer fills
+ * and keep their position inside the technicallyalac object. This wraps that
+ * fill/flush loop as a lazy range of output chunks:
+ *
+ *     talac::encoder enc(4096, 44100, 2, 16);
+ *     for(talac::chunk c : enc.packet(buffer, sizeof(buffer), frames, samples)) {
+ *         write(fd, c.data, c.size);
+ *     }
+ *
+ * Each increment of the iterator encodes exactly one more buffer's worth, so
+ * a caller that can't write right now (non-blocking socket, full pipe) can
+ * hold on to the iterator, go do something else, and increment it once the
+ * destination is writable again. Nothing here allocates heap memory: the
+ * encoder state lives inside the encoder object and the output goes into
+ * the caller's buffer. */
+
+/* like the C library, one C++ file should define TECHNICALLYALAC_IMPLEMENTATION
+ * before including this header (or technicallyalac.h) */
+
+#include "technicallyalac.h"
+
+namespace talac {
+
+/* a piece of encoded output, valid until the range is advanced */
+struct chunk {
+    const uint8_t *data;
+    uint32_t size;
+};
+
+class encoder;
+
+/* lazy sequence of chunks for one cookie or one packet */
+class chunks {
+    public:
+        class iterator {
+            public:
+                iterator() : c(nullptr) { }
+                explicit iterator(chunks *r) : c(r) { }
+
+                chunk operator*() const { return c->current; }
+                const chunk *operator->() const { return &c->current; }
+
+                iterator& operator++() {
+                    c->next();
+                    if(c->done) c = nullptr;
+                    return *this;
+                }
+
+                bool operator==(const iterator& o) const { return c == o.c; }
+                bool operator!=(const iterator& o) const { return c != o.c; }
+
+            private:
+                chunks *c;
+        };
+
+        /* starts encoding - produces the first chunk */
+        iterator begin() {
+            if(!started) {
+                started = true;
+                next();
+            }
+            return done ? iterator() : iterator(this);
+        }
+
+        iterator end() { return iterator(); }
+
+    private:
+        friend class encoder;
+
+        enum kind_e { COOKIE, PACKET };
+
+        chunks(technicallyalac *f_, enum kind_e kind_, uint8_t *buffer_, uint32_t len_, uint32_t num_frames_, int32_t **frames_)
+            : f(f_), kind(kind_), buffer(buffer_), len(len_),
+              num_frames(num_frames_), frames(frames_),
+              more(1), started(false), done(false) {
+            current.data = buffer;
+            current.size = 0;
+        }
+
+        /* encodes the next buffer's worth, skipping empty chunks */
+        void next() {
+            uint32_t bytes;
+            do {
+                if(!more || f == nullptr || len == 0) {
+                    done = true;
+                    return;
+                }
+                bytes = len;
+                if(kind == COOKIE) {
+                    more = technicallyalac_cookie(f,buffer,&bytes);
+                } else {
+                    more = technicallyalac_packet(f,buffer,&bytes,num_frames,frames);
+                }
+            } while(bytes == 0);
+            current.data = buffer;
+            current.size = bytes;
+        }
+
+        technicallyalac *f;
+        enum kind_e kind;
+        uint8_t *buffer;
+        uint32_t len;
+        uint32_t num_frames;
+        int32_t **frames;
+        int more;
+        bool started;
+        bool done;
+        chunk current;
+};
+
+/* owns a technicallyalac object. Move-only, since two copies of an encoder
+ * that's partway through a packet would both try to finish it. */
+class encoder {
+    public:
+        encoder() : valid(false) { }
+
+        encoder(uint32_t framelength, uint32_t samplerate, uint8_t channels, uint8_t bitdepth) {
+            valid = technicallyalac_init(&f,framelength,samplerate,channels,bitdepth) == 0;
+        }
+
+        encoder(const encoder&) = delete;
+        encoder& operator=(const encoder&) = delete;
+
+        encoder(encoder&& o) noexcept : f(o.f), valid(o.valid) {
+            o.valid = false;
+        }
+
+        encoder& operator=(encoder&& o) noexcept {
+            if(this != &o) {
+                f = o.f;
+                valid = o.valid;
+                o.valid = false;
+            }
+            return *this;
+        }
+
+        /* false if the parameters were rejected by technicallyalac_init,
+         * or this encoder was moved from */
+        explicit operator bool() const { return valid; }
+
+        uint32_t packet_size() { return technicallyalac_packet_size(&f); }
+        uint32_t max_packet_size() { return technicallyalac_max_packet_size(&f); }
+        static uint32_t size_cookie() { return technicallyalac_size_cookie(); }
+
+        /* the buffer must outlive the returned range, and both this encoder
+         * and the frames must stay put until the range is exhausted */
+        chunks cookie(uint8_t *buffer, uint32_t len) {
+            return chunks(valid ? &f : nullptr, chunks::COOKIE, buffer, len, 0, nullptr);
+        }
+
+        chunks packet(uint8_t *buffer, uint32_t len, uint32_t num_frames, int32_t **frames) {
+            return chunks(valid ? &f : nullptr, chunks::PACKET, buffer, len, num_frames, frames);
+        }
+
+        technicallyalac *get() { return valid ? &f : nullptr; }
+
+    private:
+        technicallyalac f;
+        bool valid;
+};
+
+}
+
+#endif